@@ -0,0 +1,35 @@
+#include "FrameBuffer.h"
+#include "Renderer.h"
+
+FrameBuffer::FrameBuffer(int width, int height)
+	: m_RendererID(0), m_ColorAttachment(0), m_Width(width), m_Height(height)
+{
+	GLCall(glGenFramebuffers(1, &m_RendererID));
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID));
+
+	GLCall(glGenRenderbuffers(1, &m_ColorAttachment));
+	GLCall(glBindRenderbuffer(GL_RENDERBUFFER, m_ColorAttachment));
+	GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height));
+	GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorAttachment));
+
+	ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE); // Break if the framebuffer can't be rendered to
+	GLCall(glBindRenderbuffer(GL_RENDERBUFFER, 0));
+	Unbind();
+}
+
+FrameBuffer::~FrameBuffer()
+{
+	GLCall(glDeleteRenderbuffers(1, &m_ColorAttachment));
+	GLCall(glDeleteFramebuffers(1, &m_RendererID));
+}
+
+void FrameBuffer::Bind() const
+{
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID)); // Binds both the draw and read framebuffer so captures read from it too
+	GLCall(glViewport(0, 0, m_Width, m_Height));
+}
+
+void FrameBuffer::Unbind() const
+{
+	GLCall(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
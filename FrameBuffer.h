@@ -0,0 +1,18 @@
+#pragma once
+
+class FrameBuffer
+{
+private:
+	unsigned int m_RendererID;
+	unsigned int m_ColorAttachment; // Renderbuffer holding the RGBA8 color image
+	int m_Width, m_Height;
+public:
+	FrameBuffer(int width, int height);
+	~FrameBuffer();
+
+	void Bind() const;
+	void Unbind() const;
+
+	inline int GetWidth() const { return m_Width; }
+	inline int GetHeight() const { return m_Height; }
+};
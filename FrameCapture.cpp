@@ -0,0 +1,99 @@
+#include "FrameCapture.h"
+#include "Renderer.h"
+#include <cstring>
+
+FrameCapture::FrameCapture(FrameWriter& writer, int width, int height, unsigned int ringSize)
+	: m_Writer(writer), m_Next(0), m_FrameCount(0), m_Stalls(0), m_Width(width), m_Height(height)
+{
+	if (ringSize < 2)
+		ringSize = 2; // With a single PBO every readback would wait on the previous one
+
+	m_Slots.resize(ringSize);
+	for (Slot& slot : m_Slots) {
+		slot.Fence = nullptr;
+		slot.FrameIndex = 0;
+		GLCall(glGenBuffers(1, &slot.PixelBuffer));
+		GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PixelBuffer));
+		GLCall(glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)m_Width * m_Height * 4, nullptr, GL_STREAM_READ)); // GL_STREAM_READ since the GPU writes it once and we read it once
+	}
+	GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+}
+
+FrameCapture::~FrameCapture()
+{
+	Finish();
+
+	for (Slot& slot : m_Slots) {
+		GLCall(glDeleteBuffers(1, &slot.PixelBuffer)); // Braces needed, GLCall expands to several statements
+	}
+}
+
+void FrameCapture::Capture()
+{
+	unsigned int count = (unsigned int)m_Slots.size();
+
+	// Hand finished readbacks to the writer, oldest first so frames stay in order, and stop at the first one the GPU hasn't finished
+	for (unsigned int i = 0; i < count; i++) {
+		Slot& slot = m_Slots[(m_Next + i) % count];
+		if (slot.Fence && !Resolve(slot, false))
+			break;
+	}
+
+	// If the ring is full we have to wait for the oldest readback, this only happens when the GPU is several frames behind
+	Slot& slot = m_Slots[m_Next];
+	if (slot.Fence) {
+		m_Stalls++;
+		Resolve(slot, true);
+	}
+
+	GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PixelBuffer));
+	GLCall(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+	GLCall(glReadPixels(0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr)); // With a PBO bound the last argument is an offset and the call returns right away
+	GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+	slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.FrameIndex = m_FrameCount++;
+	m_Next = (m_Next + 1) % count;
+}
+
+void FrameCapture::Finish()
+{
+	unsigned int count = (unsigned int)m_Slots.size();
+
+	for (unsigned int i = 0; i < count; i++) {
+		Slot& slot = m_Slots[(m_Next + i) % count];
+		if (slot.Fence)
+			Resolve(slot, true);
+	}
+}
+
+bool FrameCapture::Resolve(Slot& slot, bool wait)
+{
+	GLenum result = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0); // Timeout 0 just polls the fence
+	while (wait && result == GL_TIMEOUT_EXPIRED)
+		result = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // Wait up to a second at a time
+
+	if (result == GL_TIMEOUT_EXPIRED)
+		return false;
+	ASSERT(result != GL_WAIT_FAILED);
+
+	GLCall(glDeleteSync(slot.Fence));
+	slot.Fence = nullptr;
+
+	size_t size = (size_t)m_Width * m_Height * 4;
+	CapturedFrame frame;
+	frame.Index = slot.FrameIndex;
+	frame.Width = m_Width;
+	frame.Height = m_Height;
+	frame.Pixels = m_Writer.AcquireBuffer(size);
+
+	GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.PixelBuffer));
+	void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+	ASSERT(data);
+	std::memcpy(frame.Pixels.data(), data, size); // Copy out so the PBO can be reused while the writer encodes
+	GLCall(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+	GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+	m_Writer.Submit(std::move(frame)); // Blocks here when the writer is behind
+	return true;
+}
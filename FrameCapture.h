@@ -0,0 +1,34 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+#include "FrameWriter.h"
+
+class FrameCapture
+{
+private:
+	struct Slot {
+		unsigned int PixelBuffer; // The PBO that glReadPixels copies into without waiting for the GPU
+		GLsync Fence; // Signaled once the copy into the PBO is done, nullptr when the slot is free
+		unsigned int FrameIndex;
+	};
+
+	FrameWriter& m_Writer;
+	std::vector<Slot> m_Slots; // Ring of readbacks in flight, the oldest one is at m_Next
+	unsigned int m_Next; // The slot the next readback goes into
+	unsigned int m_FrameCount;
+	unsigned int m_Stalls; // Times Capture had to wait on the GPU because every slot in the ring was still in flight
+	int m_Width, m_Height;
+
+	bool Resolve(Slot& slot, bool wait);
+
+public:
+	FrameCapture(FrameWriter& writer, int width, int height, unsigned int ringSize = 3);
+	~FrameCapture();
+
+	void Capture(); // Queues a readback of the bound read framebuffer, call before swapping buffers
+	void Finish(); // Waits for every readback in flight and hands them to the writer
+
+	inline unsigned int GetFrameCount() const { return m_FrameCount; }
+	inline unsigned int GetStalls() const { return m_Stalls; }
+};
@@ -0,0 +1,152 @@
+#include "FrameWriter.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image/stb_image_write.h"
+#include <iostream>
+#include <cstdio>
+
+FrameWriter::FrameWriter(CaptureFormat format, const std::string& outputPath, unsigned int threadCount, unsigned int maxQueued)
+	: m_Format(format), m_OutputPath(outputPath), m_MaxQueued(maxQueued > 0 ? maxQueued : 1), m_Busy(0), m_FramesWritten(0), m_FramesFailed(0), m_Stalls(0), m_Stopping(false), m_Open(false)
+{
+	if (m_Format == CaptureFormat::RAW_VIDEO) {
+		m_RawStream.open(outputPath, std::ios::binary | std::ios::trunc);
+		m_Open = m_RawStream.is_open();
+		if (!m_Open)
+			std::cout << "\nError: Failed to open video stream " << outputPath << std::endl;
+		threadCount = 1; // The stream has to be written in frame order, and it's only a copy so one thread keeps up
+	}
+	else {
+		// Write and remove a probe file so a missing or read-only directory is reported once, before rendering starts
+		std::string probePath = outputPath + "/.capture_probe";
+		m_Open = std::ofstream(probePath, std::ios::binary).is_open();
+		std::remove(probePath.c_str());
+		if (!m_Open)
+			std::cout << "\nError: Can't write to capture directory " << outputPath << std::endl;
+		stbi_flip_vertically_on_write(1); // OpenGL reads the bottom row first but PNG starts at the top left
+	}
+
+	if (!m_Open)
+		return; // No workers, the caller is expected to check IsOpen() and not submit anything
+
+	if (threadCount == 0)
+		threadCount = 1;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		m_Workers.emplace_back(&FrameWriter::WorkerLoop, this);
+}
+
+FrameWriter::~FrameWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true; // Workers finish what is queued and then exit
+	}
+	m_FrameQueued.notify_all();
+
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+std::vector<unsigned char> FrameWriter::AcquireBuffer(size_t size)
+{
+	std::vector<unsigned char> buffer;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_FreeBuffers.empty()) {
+			buffer = std::move(m_FreeBuffers.back());
+			m_FreeBuffers.pop_back();
+		}
+	}
+	buffer.resize(size); // Keeps the old allocation as long as the frame size hasn't grown
+	return buffer;
+}
+
+void FrameWriter::Submit(CapturedFrame&& frame)
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	if (m_Queue.size() >= m_MaxQueued) {
+		m_Stalls++;
+		m_FrameTaken.wait(lock, [this] { return m_Queue.size() < m_MaxQueued; }); // Backpressure, hold the render thread until a worker catches up
+	}
+	m_Queue.push_back(std::move(frame));
+	lock.unlock();
+	m_FrameQueued.notify_one();
+}
+
+void FrameWriter::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_FrameDone.wait(lock, [this] { return m_Queue.empty() && m_Busy == 0; });
+
+	if (m_RawStream.is_open())
+		m_RawStream.flush(); // Only the single worker writes to the stream and it is idle now
+}
+
+bool FrameWriter::Close()
+{
+	Flush();
+
+	if (!m_RawStream.is_open())
+		return true; // PNG frames are checked one by one as they are written
+
+	// The end of the stream may only reach the disk here, so a full disk or network error shows up now and not in WriteFrame
+	bool flushed = m_RawStream.good();
+	m_RawStream.close();
+	if (!flushed || m_RawStream.fail()) {
+		std::cout << "\nError: Failed to finish video stream " << m_OutputPath << ", it is likely truncated" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void FrameWriter::WorkerLoop()
+{
+	while (true) {
+		CapturedFrame frame;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_FrameQueued.wait(lock, [this] { return m_Stopping || !m_Queue.empty(); });
+			if (m_Queue.empty()) // Only reached when stopping and everything has been written
+				return;
+
+			frame = std::move(m_Queue.front());
+			m_Queue.pop_front();
+			m_Busy++;
+		}
+		m_FrameTaken.notify_one();
+
+		bool written = WriteFrame(frame);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_FreeBuffers.push_back(std::move(frame.Pixels));
+			m_Busy--;
+			if (written)
+				m_FramesWritten++;
+			else if (m_FramesFailed++ == 0) // Only the first failure is printed, the rest are counted so workers don't flood the output
+				std::cout << "\nError: Failed to write frame " << frame.Index << ", further failures are only counted" << std::endl;
+		}
+		m_FrameDone.notify_all();
+	}
+}
+
+bool FrameWriter::WriteFrame(CapturedFrame& frame)
+{
+	const int stride = frame.Width * 4; // 4 bytes per pixel, RGBA
+
+	// The framebuffer alpha is whatever blending and the clear color left there, not what is seen on screen, so make every pixel opaque
+	for (size_t i = 3; i < frame.Pixels.size(); i += 4)
+		frame.Pixels[i] = 255;
+
+	if (m_Format == CaptureFormat::PNG) {
+		char filename[32];
+		std::snprintf(filename, sizeof(filename), "/frame_%05u.png", frame.Index);
+		std::string path = m_OutputPath + filename;
+
+		return stbi_write_png(path.c_str(), frame.Width, frame.Height, 4, frame.Pixels.data(), stride) != 0;
+	}
+
+	for (int row = frame.Height - 1; row >= 0; row--) // Write the rows top to bottom so the video isn't upside down
+		m_RawStream.write((const char*)frame.Pixels.data() + (size_t)row * stride, stride);
+	return m_RawStream.good(); // Once the stream fails every later frame fails too
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <atomic>
+
+enum class CaptureFormat {
+	PNG, // One PNG file per frame, encoded in parallel by the worker threads
+	RAW_VIDEO // Every frame appended to a single raw RGBA stream, e.g. ffmpeg -f rawvideo -pix_fmt rgba -s WxH -i out.raw
+};
+
+struct CapturedFrame {
+	unsigned int Index; // The number of the frame since capture started
+	int Width, Height;
+	std::vector<unsigned char> Pixels; // RGBA8 pixels, bottom row first as they come out of glReadPixels
+};
+
+class FrameWriter
+{
+private:
+	CaptureFormat m_Format;
+	std::string m_OutputPath; // The directory for PNG frames or the file for the raw stream
+	unsigned int m_MaxQueued; // How many frames may wait for a worker before Submit blocks the render thread
+	std::vector<std::thread> m_Workers;
+	std::deque<CapturedFrame> m_Queue;
+	std::vector<std::vector<unsigned char>> m_FreeBuffers; // Pixel buffers handed back by the workers so frames don't allocate
+	std::mutex m_Mutex;
+	std::condition_variable m_FrameQueued, m_FrameTaken, m_FrameDone;
+	unsigned int m_Busy; // Workers currently writing a frame
+	std::atomic<unsigned int> m_FramesWritten; // Only frames that actually reached the disk
+	std::atomic<unsigned int> m_FramesFailed;
+	unsigned int m_Stalls; // Times Submit had to wait because the workers fell behind
+	bool m_Stopping;
+	bool m_Open; // Whether the output could be opened, nothing is written otherwise
+	std::ofstream m_RawStream;
+
+	void WorkerLoop();
+	bool WriteFrame(CapturedFrame& frame);
+
+public:
+	FrameWriter(CaptureFormat format, const std::string& outputPath, unsigned int threadCount, unsigned int maxQueued);
+	~FrameWriter();
+
+	std::vector<unsigned char> AcquireBuffer(size_t size); // Gets a recycled buffer of the given size
+	void Submit(CapturedFrame&& frame); // Queues a frame, blocks while the queue is full
+	void Flush(); // Waits until every queued frame has been written
+	bool Close(); // Flushes and closes the output, returns false if the last buffered data couldn't be written
+
+	inline bool IsOpen() const { return m_Open; }
+	inline unsigned int GetFramesWritten() const { return m_FramesWritten; }
+	inline unsigned int GetFramesFailed() const { return m_FramesFailed; }
+	inline unsigned int GetStalls() const { return m_Stalls; }
+};
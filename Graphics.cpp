@@ -4,6 +4,10 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <thread>
+#include <memory>
 #include "Renderer.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
@@ -11,6 +15,9 @@
 #include "VertexBufferLayout.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "FrameBuffer.h"
+#include "FrameCapture.h"
+#include "FrameWriter.h"
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -34,8 +41,72 @@ void processInput(GLFWwindow* window)
     }
 }
 
-int main(void)
+void printUsage(const char* program)
 {
+    std::cout << "Usage: " << program << " [--capture <dir> | --video <file>] [--frames <n>] [--headless]\n"
+        << "  --capture <dir>  Write every frame as a PNG into an existing directory\n"
+        << "  --video <file>   Write every frame to a raw RGBA video stream\n"
+        << "  --frames <n>     Stop after n frames\n"
+        << "  --headless       Render offscreen without showing a window, needs --frames and still needs a display (e.g. xvfb-run)" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    // Capture options: --capture <dir> writes PNG frames, --video <file> writes a raw RGBA stream,
+    // --frames <n> stops after n frames and --headless renders offscreen without showing a window.
+    // Headless mode still creates a hidden GLFW window for the context, so it needs a display server (or Xvfb) to connect to
+    const char* captureDir = nullptr;
+    const char* videoPath = nullptr;
+    unsigned int maxFrames = 0; // 0 means run until the window is closed
+    bool headless = false;
+
+    // Any mistake stops the run, a batch job that silently renders without capturing would look like it succeeded
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            headless = true;
+        }
+        else if (std::strcmp(argv[i], "--capture") == 0 && hasValue) {
+            captureDir = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--video") == 0 && hasValue) {
+            videoPath = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && hasValue) {
+            char* end = nullptr;
+            maxFrames = (unsigned int)std::strtoul(argv[++i], &end, 10);
+            if (*end != '\0' || maxFrames == 0) {
+                std::cout << "--frames needs a positive number, got " << argv[i] << std::endl;
+                printUsage(argv[0]);
+                return -1;
+            }
+        }
+        else {
+            bool knownOption = std::strcmp(argv[i], "--capture") == 0 || std::strcmp(argv[i], "--video") == 0 || std::strcmp(argv[i], "--frames") == 0;
+            std::cout << (knownOption ? "Missing value for " : "Unknown option ") << argv[i] << std::endl;
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (captureDir && videoPath) {
+        std::cout << "--capture and --video can't be used together" << std::endl;
+        printUsage(argv[0]);
+        return -1;
+    }
+
+    bool capturing = captureDir || videoPath;
+    if (headless && maxFrames == 0) {
+        std::cout << "--headless needs --frames, there is no window to close" << std::endl;
+        return -1;
+    }
+
+#if defined(__linux__) || defined(__FreeBSD__) // Only X11/Wayland platforms need these, Windows and macOS create hidden windows without them
+    if (headless && !std::getenv("DISPLAY") && !std::getenv("WAYLAND_DISPLAY")) { // Fail with a clear message instead of a GLFW init error
+        std::cout << "--headless still needs a display for its hidden window, none is set. Run under a virtual display, e.g. xvfb-run" << std::endl;
+        return -1;
+    }
+#endif
 
     /* Initialize the library */
     if (!glfwInit())
@@ -44,11 +115,17 @@ int main(void)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); // Set the major version of OpenGL to 3
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3); // Set the minor version of OpenGL to 3
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE); // Set the OpenGL profile to core
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); // Still need a window for the context, but it is never shown
+    if (capturing)
+        glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE); // The capture buffers are sized once from the framebuffer size, so keep the user from changing it
 
     /* Create a windowed mode window and its OpenGL context */
     GLFWwindow* window = glfwCreateWindow(800, 600, "OpenGL Learning", NULL, NULL);
     if (!window)
     {
+        if (headless)
+            std::cout << "Failed to create the hidden window for --headless, it needs a working display" << std::endl;
         glfwTerminate();
         return -1;
     }
@@ -57,12 +134,14 @@ int main(void)
     glfwMakeContextCurrent(window); // IMPORTANT: Must be done so glew recognises OpenGL
     glViewport(0, 0, 800, 600); // Set the viewport to the whole window
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);// Set the callback function for when the window is resized
-    glfwSwapInterval(1); // Enable vsync
+    glfwSwapInterval(headless ? 0 : 1); // Enable vsync, except in headless mode where nothing is presented and we render as fast as we can
 
     if (glewInit() != GLEW_OK) {
         std::cout << "GLEW ERROR" << std::endl;
     }
 
+    int exitCode = 0; // Set when capturing fails, so batch jobs can tell a run that wrote nothing
+
 
 
     
@@ -109,6 +188,40 @@ int main(void)
         shader.Unbind();
 
         Renderer renderer; // Create a renderer
+
+        // Headless rendering goes to an offscreen framebuffer since the contents of a hidden window aren't guaranteed
+        std::unique_ptr<FrameBuffer> offscreen;
+        if (headless)
+            offscreen = std::make_unique<FrameBuffer>(800, 600);
+        if (offscreen)
+            offscreen->Bind();
+
+        // The writer is declared first so it outlives the capture, which hands it frames until it is destroyed
+        std::unique_ptr<FrameWriter> writer;
+        std::unique_ptr<FrameCapture> capture;
+        int captureWidth = 0, captureHeight = 0;
+        if (offscreen) {
+            captureWidth = offscreen->GetWidth();
+            captureHeight = offscreen->GetHeight();
+        }
+        else {
+            glfwGetFramebufferSize(window, &captureWidth, &captureHeight); // In pixels, which on HiDPI displays is more than the 800x600 window size
+            GLCall(glViewport(0, 0, captureWidth, captureHeight));
+        }
+
+        if (capturing) {
+            unsigned int threads = std::thread::hardware_concurrency();
+            threads = threads > 2 ? threads - 1 : 1; // Leave a core for the render thread
+            if (videoPath)
+                writer = std::make_unique<FrameWriter>(CaptureFormat::RAW_VIDEO, videoPath, 1, 8);
+            else
+                writer = std::make_unique<FrameWriter>(CaptureFormat::PNG, captureDir, threads, threads * 2);
+            if (writer->IsOpen())
+                capture = std::make_unique<FrameCapture>(*writer, captureWidth, captureHeight);
+            else
+                exitCode = -1; // The writer already said why, skip rendering instead of producing nothing
+        }
+        unsigned int frame = 0;
         
         float r = 0.0f; // The red value of the color
         float increment = 0.05f; // The amount to increment the red value by
@@ -116,7 +229,7 @@ int main(void)
         //GLCall(glPolygonMode(GL_FRONT_AND_BACK, GL_TRIANGLES));
 
         /* Loop until the user closes the window */
-        while (!glfwWindowShouldClose(window))
+        while (exitCode == 0 && !glfwWindowShouldClose(window) && (maxFrames == 0 || frame < maxFrames))
         {
         
             // Input
@@ -144,14 +257,35 @@ int main(void)
             r += increment; // Increment the red value
 
 
+            if (capture)
+                capture->Capture(); // Must happen before the swap, the back buffer is undefined afterwards
+            frame++;
+
             /* Swap front and back buffers */
-            GLCall(glfwSwapBuffers(window));
+            if (!headless) {
+                GLCall(glfwSwapBuffers(window)); // Braces needed, GLCall expands to several statements
+            }
 
             /* Poll for and process events */
             GLCall(glfwPollEvents());
         }
+
+        if (capture) {
+            capture->Finish(); // Hand over the readbacks still in flight
+            bool closed = writer->Close();
+            std::cout << "Captured " << writer->GetFramesWritten() << " frames" << std::endl;
+            std::cout << "Rendering stalled " << capture->GetStalls() << " times on a full readback ring and " << writer->GetStalls() << " times on a full writer queue" << std::endl;
+            if (videoPath) // The raw stream has no header, so ffmpeg needs the size and format given to it
+                std::cout << "Video is " << captureWidth << "x" << captureHeight << " RGBA, convert with: ffmpeg -f rawvideo -pix_fmt rgba -s " << captureWidth << "x" << captureHeight << " -i " << videoPath << " out.mp4" << std::endl;
+            if (writer->GetFramesFailed() > 0) {
+                std::cout << "Error: " << writer->GetFramesFailed() << " frames could not be written" << std::endl;
+                exitCode = -1;
+            }
+            if (!closed)
+                exitCode = -1; // Close already printed why
+        }
     }
 
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
\ No newline at end of file